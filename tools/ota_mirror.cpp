@@ -0,0 +1,439 @@
+// ota_mirror - serve the ota/ directory over plain HTTP on a LAN.
+//
+// Lets a site or a lab bench run rollouts without reaching
+// raw.githubusercontent.com. Supports GET/HEAD, single byte ranges,
+// ETag / If-None-Match and an optional pre-compressed "<name>.gz" sibling.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -o ota_mirror tools/ota_mirror.cpp
+// Run:    ./ota_mirror --root ota --port 8080 --base-url http://192.168.1.10:8080/ota/
+
+#include <arpa/inet.h>
+#include <cctype>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <netinet/in.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+// Prefix the release script writes into manifest.json asset URLs.
+const char kUpstreamPrefix[] =
+    "https://raw.githubusercontent.com/ChatpetchDatesatarn/EarthQuake_OTA/main/ota/";
+
+const size_t kMaxRequestBytes = 8192;
+
+// Applies to both directions, so a peer that stops reading mid-download
+// (e.g. a gateway that dropped off Wi-Fi) releases its thread.
+const int kSocketTimeoutSec = 10;
+
+struct Config {
+  std::string root = "ota";
+  std::string base_url;  // empty: serve manifest.json unchanged
+  int port = 8080;
+};
+
+struct Request {
+  std::string method;
+  std::string path;
+  std::string range;
+  std::string if_none_match;
+  std::string accept_encoding;
+};
+
+// Whole-file read, only used for small files (sidecars, the manifest
+// when it is rewritten).
+bool read_file(const std::string& path, std::string& out) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+std::string lower(std::string s) {
+  for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return s;
+}
+
+std::string trim(const std::string& s) {
+  size_t b = s.find_first_not_of(" \t");
+  if (b == std::string::npos) return "";
+  size_t e = s.find_last_not_of(" \t\r");
+  return s.substr(b, e - b + 1);
+}
+
+bool parse_request(const std::string& raw, Request& req) {
+  std::istringstream in(raw);
+  std::string line;
+  if (!std::getline(in, line)) return false;
+  std::istringstream start(line);
+  std::string version;
+  if (!(start >> req.method >> req.path >> version)) return false;
+
+  while (std::getline(in, line)) {
+    line = trim(line);
+    if (line.empty()) break;
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = lower(trim(line.substr(0, colon)));
+    std::string value = trim(line.substr(colon + 1));
+    if (name == "range") req.range = value;
+    else if (name == "if-none-match") req.if_none_match = value;
+    else if (name == "accept-encoding") req.accept_encoding = lower(value);
+  }
+  return true;
+}
+
+// Maps a request path to a file name inside root. Anything up to and
+// including "/ota/" is dropped so that URLs keeping the GitHub layout
+// (".../main/ota/<file>") resolve as well as plain "/<file>".
+bool resolve_name(std::string path, std::string& name) {
+  size_t q = path.find('?');
+  if (q != std::string::npos) path.erase(q);
+  size_t ota = path.rfind("/ota/");
+  name = ota != std::string::npos ? path.substr(ota + 5) : path.substr(1);
+  if (name.empty()) name = "manifest.json";
+  return name.find('/') == std::string::npos && name[0] != '.';
+}
+
+std::string content_type(const std::string& name) {
+  auto ends_with = [&](const char* ext) {
+    size_t n = std::strlen(ext);
+    return name.size() >= n && name.compare(name.size() - n, n, ext) == 0;
+  };
+  if (ends_with(".json")) return "application/json";
+  if (ends_with(".sha256")) return "text/plain";
+  return "application/octet-stream";
+}
+
+std::string fnv1a_etag(const std::string& body) {
+  uint64_t h = 1469598103934665603ULL;
+  for (unsigned char c : body) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  char buf[24];
+  std::snprintf(buf, sizeof(buf), "\"%016llx\"", static_cast<unsigned long long>(h));
+  return buf;
+}
+
+// Uses the published .sha256 sidecar when there is one, so the ETag a
+// client sees is the same digest the manifest lists for the image.
+// Otherwise falls back to size and mtime, which needs no read.
+std::string etag_for(const std::string& path, const struct stat& st) {
+  std::string sidecar;
+  if (read_file(path + ".sha256", sidecar)) {
+    sidecar = trim(sidecar.substr(0, sidecar.find_first_of(" \r\n")));
+    if (sidecar.size() == 64) return "\"" + sidecar + "\"";
+  }
+  char buf[48];
+  std::snprintf(buf, sizeof(buf), "\"%llx-%llx\"", static_cast<unsigned long long>(st.st_size),
+                static_cast<unsigned long long>(st.st_mtime));
+  return buf;
+}
+
+bool etag_matches(const std::string& header, const std::string& etag) {
+  if (header == "*") return true;
+  std::istringstream in(header);
+  std::string tag;
+  while (std::getline(in, tag, ',')) {
+    tag = trim(tag);
+    if (tag.compare(0, 2, "W/") == 0) tag.erase(0, 2);
+    if (tag == etag) return true;
+  }
+  return false;
+}
+
+// True when Accept-Encoding allows gzip: an explicit gzip entry wins over
+// "*", and q=0 (or any q that parses to zero) is a refusal.
+bool accepts_gzip(const std::string& header) {
+  int gzip = -1, any = -1;  // -1: not listed, 0: refused, 1: accepted
+  std::istringstream in(header);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    size_t semi = item.find(';');
+    std::string coding = lower(trim(item.substr(0, semi)));
+    double q = 1.0;
+    while (semi != std::string::npos) {
+      size_t next = item.find(';', semi + 1);
+      std::string param = lower(trim(item.substr(semi + 1, next - semi - 1)));
+      if (param.compare(0, 2, "q=") == 0) q = std::strtod(param.c_str() + 2, nullptr);
+      semi = next;
+    }
+    if (coding == "gzip" || coding == "x-gzip") gzip = q > 0 ? 1 : 0;
+    else if (coding == "*") any = q > 0 ? 1 : 0;
+  }
+  return gzip == 1 || (gzip == -1 && any == 1);
+}
+
+// Parses a single "bytes=" range. Returns false for anything it does not
+// understand (including multi-range), in which case the full body is sent.
+bool parse_range(const std::string& header, size_t size, size_t& first, size_t& last,
+                 bool& satisfiable) {
+  satisfiable = true;
+  if (header.compare(0, 6, "bytes=") != 0) return false;
+  std::string spec = header.substr(6);
+  if (spec.find(',') != std::string::npos) return false;
+  size_t dash = spec.find('-');
+  if (dash == std::string::npos) return false;
+  std::string a = trim(spec.substr(0, dash));
+  std::string b = trim(spec.substr(dash + 1));
+  if (a.empty() && b.empty()) return false;
+  char* end = nullptr;
+
+  if (a.empty()) {
+    unsigned long long suffix = std::strtoull(b.c_str(), &end, 10);
+    if (*end) return false;
+    if (suffix == 0 || size == 0) {
+      satisfiable = false;
+      return true;
+    }
+    first = suffix >= size ? 0 : size - suffix;
+    last = size - 1;
+    return true;
+  }
+
+  unsigned long long lo = std::strtoull(a.c_str(), &end, 10);
+  if (*end) return false;
+  unsigned long long hi = size ? size - 1 : 0;
+  if (!b.empty()) {
+    hi = std::strtoull(b.c_str(), &end, 10);
+    if (*end || hi < lo) return false;
+    if (hi >= size) hi = size ? size - 1 : 0;
+  }
+  if (lo >= size) {
+    satisfiable = false;
+    return true;
+  }
+  first = lo;
+  last = hi;
+  return true;
+}
+
+void replace_all(std::string& s, const std::string& from, const std::string& to) {
+  for (size_t pos = s.find(from); pos != std::string::npos; pos = s.find(from, pos + to.size()))
+    s.replace(pos, from.size(), to);
+}
+
+bool send_all(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Streams [first, first + len) of the file at path without loading it.
+bool send_file_range(int fd, const std::string& path, size_t first, size_t len) {
+  int in = open(path.c_str(), O_RDONLY);
+  if (in < 0) return false;
+  char buf[16384];
+  bool ok = true;
+  off_t off = static_cast<off_t>(first);
+  while (ok && len > 0) {
+    ssize_t n = pread(in, buf, len < sizeof(buf) ? len : sizeof(buf), off);
+    if (n <= 0) {
+      ok = false;
+      break;
+    }
+    ok = send_all(fd, buf, static_cast<size_t>(n));
+    off += n;
+    len -= static_cast<size_t>(n);
+  }
+  close(in);
+  return ok;
+}
+
+// Sends a header-only response. A 304 carries no Content-Length: it
+// would have to match the full 200 body (RFC 9110 8.6), not zero.
+int send_status(int fd, int code, const char* reason, const std::string& extra = "") {
+  std::string head = "HTTP/1.1 " + std::to_string(code) + " " + reason + "\r\n" + extra +
+                     (code == 304 ? "" : "Content-Length: 0\r\n") + "Connection: close\r\n\r\n";
+  send_all(fd, head.data(), head.size());
+  return code;
+}
+
+int handle(int fd, const Config& cfg, const Request& req, size_t& sent) {
+  sent = 0;
+  bool head_only = req.method == "HEAD";
+  if (req.method != "GET" && !head_only)
+    return send_status(fd, 405, "Method Not Allowed", "Allow: GET, HEAD\r\n");
+
+  std::string name;
+  if (!resolve_name(req.path, name)) return send_status(fd, 400, "Bad Request");
+
+  // The file body is only read when bytes are actually sent; the manifest
+  // is the exception when it has to be rewritten, and it is small.
+  std::string path = cfg.root + "/" + name;
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    return send_status(fd, 404, "Not Found");
+  size_t size = static_cast<size_t>(st.st_size);
+
+  std::string body;
+  bool in_memory = false;
+  std::string etag;
+  if (name == "manifest.json" && !cfg.base_url.empty()) {
+    if (!read_file(path, body)) return send_status(fd, 404, "Not Found");
+    replace_all(body, kUpstreamPrefix, cfg.base_url);
+    in_memory = true;
+    size = body.size();
+    etag = fnv1a_etag(body);
+  } else {
+    etag = etag_for(path, st);
+  }
+
+  // A pre-compressed sibling is only offered for whole-body requests;
+  // ranges always address the identity encoding the manifest hashes. A
+  // rewritten manifest never uses it: the .gz on disk has upstream URLs.
+  std::string encoding;
+  struct stat gz_st;
+  if (!in_memory && req.range.empty() && accepts_gzip(req.accept_encoding) &&
+      stat((path + ".gz").c_str(), &gz_st) == 0 && S_ISREG(gz_st.st_mode)) {
+    path += ".gz";
+    size = static_cast<size_t>(gz_st.st_size);
+    encoding = "Content-Encoding: gzip\r\n";
+    etag.insert(etag.size() - 1, "-gz");
+  }
+
+  std::string common = "ETag: " + etag + "\r\nAccept-Ranges: bytes\r\nVary: Accept-Encoding\r\n";
+  if (!req.if_none_match.empty() && etag_matches(req.if_none_match, etag))
+    return send_status(fd, 304, "Not Modified", common);
+
+  int code = 200;
+  size_t first = 0, last = size ? size - 1 : 0;
+  std::string range_header;
+  bool satisfiable = true;
+  if (!req.range.empty() && parse_range(req.range, size, first, last, satisfiable)) {
+    if (!satisfiable)
+      return send_status(fd, 416, "Range Not Satisfiable",
+                         "Content-Range: bytes */" + std::to_string(size) + "\r\n");
+    code = 206;
+    range_header = "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                   "/" + std::to_string(size) + "\r\n";
+  }
+  size_t length = size ? last - first + 1 : 0;
+
+  std::string head = "HTTP/1.1 " + std::to_string(code) +
+                     (code == 206 ? " Partial Content\r\n" : " OK\r\n") + common + encoding +
+                     range_header + "Content-Type: " + content_type(name) +
+                     "\r\nContent-Length: " + std::to_string(length) +
+                     "\r\nConnection: close\r\n\r\n";
+  if (!send_all(fd, head.data(), head.size())) return code;
+  if (head_only || length == 0) return code;
+  bool ok = in_memory ? send_all(fd, body.data() + first, length)
+                      : send_file_range(fd, path, first, length);
+  if (ok) sent = length;
+  return code;
+}
+
+void serve_client(int fd, const Config& cfg, const std::string& peer) {
+  timeval tv{kSocketTimeoutSec, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  std::string raw;
+  char buf[1024];
+  while (raw.find("\r\n\r\n") == std::string::npos && raw.size() < kMaxRequestBytes) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return;
+    raw.append(buf, static_cast<size_t>(n));
+  }
+
+  Request req;
+  if (!parse_request(raw, req)) {
+    send_status(fd, 400, "Bad Request");
+    return;
+  }
+  size_t sent = 0;
+  int code = handle(fd, cfg, req, sent);
+  std::printf("%s %s %s -> %d (%zu bytes)\n", peer.c_str(), req.method.c_str(),
+              req.path.c_str(), code, sent);
+  std::fflush(stdout);
+}
+
+void usage(const char* argv0) {
+  std::fprintf(stderr,
+               "Usage: %s [--root DIR] [--port N] [--base-url URL]\n"
+               "  --root DIR      directory to serve (default: ota)\n"
+               "  --port N        TCP port, 1-65535 (default: 8080)\n"
+               "  --base-url URL  rewrite manifest asset URLs to this prefix\n",
+               argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Config cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--root" && i + 1 < argc) cfg.root = argv[++i];
+    else if (arg == "--port" && i + 1 < argc) {
+      char* end = nullptr;
+      long port = std::strtol(argv[++i], &end, 10);
+      if (*end || end == argv[i] || port < 1 || port > 65535) {
+        usage(argv[0]);
+        return 1;
+      }
+      cfg.port = static_cast<int>(port);
+    }
+    else if (arg == "--base-url" && i + 1 < argc) cfg.base_url = argv[++i];
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!cfg.base_url.empty() && cfg.base_url.back() != '/') cfg.base_url += '/';
+
+  std::signal(SIGPIPE, SIG_IGN);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) {
+    std::perror("socket");
+    return 1;
+  }
+  int yes = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(cfg.port));
+  if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(listener, 16) < 0) {
+    std::perror("bind/listen");
+    return 1;
+  }
+  std::printf("Serving %s on port %d\n", cfg.root.c_str(), cfg.port);
+  std::fflush(stdout);
+
+  // One thread per connection: a stalled client must not hold up the
+  // other nodes of a rollout.
+  for (;;) {
+    sockaddr_in peer{};
+    socklen_t peer_len = sizeof(peer);
+    int fd = accept(listener, reinterpret_cast<sockaddr*>(&peer), &peer_len);
+    if (fd < 0) continue;
+    char ip[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &peer.sin_addr, ip, sizeof(ip));
+    std::string peer_ip = ip;
+    std::thread([fd, &cfg, peer_ip] {
+      serve_client(fd, cfg, peer_ip);
+      close(fd);
+    }).detach();
+  }
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env bash
+# Host test for tools/ota_mirror.cpp: builds it, serves a small fixture
+# directory and checks the responses with curl.
+#
+# Usage: tools/test_ota_mirror.sh   (PORT=18080 by default)
+
+set -u
+
+here="$(cd "$(dirname "$0")" && pwd)"
+port="${PORT:-18080}"
+work="$(mktemp -d)"
+base="http://127.0.0.1:$port"
+failures=0
+
+cleanup() {
+  [ -n "${server_pid:-}" ] && kill "$server_pid" 2>/dev/null
+  rm -rf "$work"
+}
+trap cleanup EXIT
+
+check() {  # check <description> <expected> <actual>
+  if [ "$2" = "$3" ]; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1: expected '$2', got '$3'"
+    failures=$((failures + 1))
+  fi
+}
+
+status() { curl -s -o /dev/null -w '%{http_code}' "$@"; }
+header() {  # header <name> <curl args...>
+  local name="$1"; shift
+  curl -s -D - -o /dev/null "$@" | tr -d '\r' | grep -i "^$name:" | cut -d' ' -f2-
+}
+
+g++ -std=c++17 -O2 -pthread -Wall -Wextra -o "$work/ota_mirror" "$here/ota_mirror.cpp" || exit 1
+
+# Fixture: a 1000-byte image with a sidecar and a .gz sibling, and a
+# manifest (plus .gz) still pointing at the upstream URLs.
+root="$work/ota"
+mkdir -p "$root"
+head -c 1000 /dev/urandom > "$root/node.bin"
+sha256sum "$root/node.bin" | cut -d' ' -f1 > "$root/node.bin.sha256"
+gzip -k "$root/node.bin"
+sha="$(cat "$root/node.bin.sha256")"
+upstream="https://raw.githubusercontent.com/ChatpetchDatesatarn/EarthQuake_OTA/main/ota/"
+printf '{"assets":{"a":"%snode.bin","b":"%snode.bin"}}\n' "$upstream" "$upstream" \
+  > "$root/manifest.json"
+gzip -k "$root/manifest.json"
+
+for bad in abc 0 70000; do
+  "$work/ota_mirror" --port "$bad" 2>/dev/null
+  check "--port $bad rejected" 1 "$?"
+done
+
+"$work/ota_mirror" --root "$root" --port "$port" --base-url "http://10.0.0.1:8080/ota" \
+  > "$work/server.log" 2>&1 &
+server_pid=$!
+for _ in $(seq 50); do status "$base/node.bin" > /dev/null && break; sleep 0.1; done
+
+# Ranges
+check "full body" "$sha" "$(curl -s "$base/node.bin" | sha256sum | cut -d' ' -f1)"
+check "suffix range status" 206 "$(status -r -100 "$base/node.bin")"
+check "suffix range header" "bytes 900-999/1000" "$(header Content-Range -r -100 "$base/node.bin")"
+check "suffix longer than file" "bytes 0-999/1000" \
+  "$(header Content-Range -r -5000 "$base/node.bin")"
+check "range bytes" "$(tail -c +11 "$root/node.bin" | head -c 10 | od -An -tx1)" \
+  "$(curl -s -r 10-19 "$base/node.bin" | od -An -tx1)"
+check "lo >= size is 416" 416 "$(status -r 1000- "$base/node.bin")"
+check "416 Content-Range" "bytes */1000" "$(header Content-Range -r 1000- "$base/node.bin")"
+check "hi clamped to size" "bytes 990-999/1000" \
+  "$(header Content-Range -r 990-5000 "$base/node.bin")"
+check "multi-range falls back to 200" 200 "$(status -r 0-1,5-6 "$base/node.bin")"
+check "GitHub path layout" 200 \
+  "$(status "$base/ChatpetchDatesatarn/EarthQuake_OTA/main/ota/node.bin")"
+
+# Path handling
+check "dot-dot rejected" 400 "$(status --path-as-is "$base/../manifest.json")"
+check "dot-dot after /ota/ rejected" 400 "$(status --path-as-is "$base/ota/../node.bin")"
+check "subdirectory rejected" 400 "$(status "$base/a/node.bin")"
+check "dotfile rejected" 400 "$(status "$base/.hidden")"
+check "missing file" 404 "$(status "$base/missing.bin")"
+check "POST not allowed" 405 "$(status -X POST "$base/node.bin")"
+
+# ETag / 304
+check "ETag from sidecar" "\"$sha\"" "$(header ETag "$base/node.bin")"
+check "If-None-Match gives 304" 304 "$(status -H "If-None-Match: \"$sha\"" "$base/node.bin")"
+check "304 has no Content-Length" "" \
+  "$(header Content-Length -H "If-None-Match: \"$sha\"" "$base/node.bin")"
+
+# Compression
+check "gzip served" gzip "$(header Content-Encoding -H 'Accept-Encoding: gzip' "$base/node.bin")"
+check "gzip;q=0 refused" "" \
+  "$(header Content-Encoding -H 'Accept-Encoding: identity, gzip;q=0' "$base/node.bin")"
+check "gzip not used for ranges" "" \
+  "$(header Content-Encoding -H 'Accept-Encoding: gzip' -r 0-9 "$base/node.bin")"
+check "gzip body decodes" "$sha" \
+  "$(curl -s --compressed "$base/node.bin" | sha256sum | cut -d' ' -f1)"
+
+# Manifest rewrite, with and without gzip
+check "manifest rewritten" 2 "$(curl -s "$base/manifest.json" | grep -o '10\.0\.0\.1' | wc -l)"
+check "rewritten manifest skips .gz" "" \
+  "$(header Content-Encoding -H 'Accept-Encoding: gzip' "$base/manifest.json")"
+check "rewritten manifest via gzip client" 2 \
+  "$(curl -s --compressed "$base/manifest.json" | grep -o '10\.0\.0\.1' | wc -l)"
+
+# A connection that never sends its request must not block others.
+exec 3<>"/dev/tcp/127.0.0.1/$port"
+check "served while another client stalls" 200 "$(status -m 3 "$base/manifest.json")"
+exec 3>&-
+
+if [ "$failures" -ne 0 ]; then
+  echo "$failures check(s) failed"
+  exit 1
+fi
+echo "all checks passed"